@@ -37,6 +37,10 @@
 #define OSB_ENABLEEVENT  14
 #define OSB_DISABLEEVENT 13
 
+/* OS_Word routines */
+#define OSW_POINTER      21
+#define POINTER_SETMOUSE 3  /* OSW_POINTER reason code */
+
 /* Vector numbers */
 #define VECTOR_EVENTV    16
 
@@ -53,9 +57,24 @@
 #define KEY_KPPLUS  75  /* fire 2 */
 
 /* Imaginary joystick state */
-static signed char x_axis,y_axis;
+static uint32_t axes; /* x (bits 16-31) and y (bits 0-15), each + AXIS_BIAS */
 static unsigned char buttons; /* bit field */
 
+/* Both axes are packed into one word so that the analogue ticker can
+   update them together (SIMD within a register). The bias keeps each
+   16-bit lane positive, so lanes never carry or borrow into each other. */
+#define AXIS_BIAS   0x100
+#define AXIS_STEP   5
+#define AXES_LANES  0x00010001u /* one in each lane */
+#define AXES_CENTRE (AXES_LANES * AXIS_BIAS)
+#define AXES_MAX    (AXES_LANES * (AXIS_BIAS + 127))
+#define AXES_MIN    (AXES_LANES * (AXIS_BIAS - 127))
+
+#define AXES_X(a) ((signed int)((a) >> 16) - AXIS_BIAS)
+#define AXES_Y(a) ((signed int)((a) & 0xffffu) - AXIS_BIAS)
+#define AXES_SET_X(a, x) ((a) = ((a) & 0xffffu) | ((uint32_t)((x) + AXIS_BIAS) << 16))
+#define AXES_SET_Y(a, y) ((a) = ((a) & 0xffff0000u) | (uint32_t)((y) + AXIS_BIAS))
+
 static char mode; /* type of emulation */
 #define MODE_SWITCHED 0
 #define MODE_ANALOGUE 1
@@ -66,14 +85,76 @@ static char mode; /* type of emulation */
 #define DECAY_DIVISOR_A (1 << 4)
 #define DECAY_DIVISOR_B (1 << 5)
 
-static bool fake_calibrate_TR; /* waiting for Joystick_CalibrateBottomLeft? */
-static bool fake_calibrate_BL; /* waiting for Joystick_CalibrateTopRight? */
+/* Calibration */
+static char calibrating; /* non-zero whilst calibration is incomplete */
+#define CALIB_AWAIT_BL 1 /* waiting for Joystick_CalibrateBottomLeft */
+#define CALIB_AWAIT_TR 2 /* waiting for Joystick_CalibrateTopRight */
+
+#define AXIS_X 0
+#define AXIS_Y 1
+#define RANGE_16 (127 << 8) /* full deflection at 16-bit resolution */
 
-static bool left, right, up, down; /* keys pressed state */
+static signed int calib_tr[2], calib_bl[2]; /* captured positions */
+
+/* Calibrated output indexed by 8-bit position + 128, and by 16-bit
+   position / 256 + 128 (interpolated using the remainder) */
+static signed char calib_8[2][256];
+static unsigned short calib_16[2][257];
+
+static uint32_t keys; /* keys pressed state (bit field) */
+#define KEYS_UP    (1u << 0)  /* in y lane */
+#define KEYS_DOWN  (1u << 1)
+#define KEYS_LEFT  (1u << 16) /* in x lane */
+#define KEYS_RIGHT (1u << 17)
 
 static signed int damp_x, damp_y; /* for damping algorithm */ 
 
-extern _kernel_oserror bad_reason, error_no_mem, error_analogue, error_calib, FakeJSType_syntax; /* error blocks, assembled separately */
+/* Input sources */
+#define SOURCE_KEYPAD 0
+#define SOURCE_MOUSE  1
+#define SOURCE_INJECT 2
+#define SOURCE_COUNT  3
+
+/* Enabled input sources (bit field). Each source's enable and disable
+   routines set and clear its own bit, so callers needn't. */
+static unsigned int sources;
+
+/* Each source contributes a position in units of 1/FIXED_POINT_ONE, except
+   for the keypad, whose position depends on the type of emulation */
+#define MOUSE_GAIN_DEFAULT 64  /* 16-bit counts per OS unit (4 OS units per 8-bit step) */
+#define MOUSE_GAIN_MAX     256 /* 1 OS unit per 8-bit step */
+
+static unsigned int mouse_gain;  /* 16-bit counts per OS unit */
+static signed int mouse_pos[2];  /* accumulated pointer movement */
+static signed int mouse_home[2]; /* pointer position to return to after reading */
+static unsigned char mouse_buttons;
+static bool callback_pending;    /* waiting to read the pointer? */
+
+static signed int inject_pos[2];
+static unsigned char inject_buttons;
+
+/* Sum of all sources (uncalibrated) and the resulting values for
+   Joystick_Read 0 and 1, which are updated whenever a source changes */
+static signed int merged_pos[2];
+static uint32_t published_8, published_16;
+
+static bool ticker_on; /* OS_CallEvery routine attached? */
+
+/* Input latency measurement */
+#define MODE_COUNT      3
+#define LATENCY_BUCKETS 32  /* one per centisecond, plus an overflow bucket */
+#define LATENCY_TIMEOUT 100 /* give up waiting for a visible effect after 1 s */
+
+static bool latency_enabled;
+static bool latency_pending;        /* key event not yet seen by Joystick_Read? */
+static char latency_mode;           /* emulation type when event occurred */
+static unsigned int latency_time;   /* monotonic time of event */
+static unsigned int latency_before; /* joystick state before event */
+static unsigned int latency_after;  /* predicted joystick state after event */
+static unsigned int latency_hist[MODE_COUNT][LATENCY_BUCKETS + 1];
+static unsigned int latency_lost[MODE_COUNT]; /* events with no visible effect */
+
+extern _kernel_oserror bad_reason, error_no_mem, error_analogue, error_calib, error_save, error_stick, error_source, FakeJSType_syntax, FakeJSLatency_syntax, FakeJSSource_syntax; /* error blocks, assembled separately */
 
 /* Convert supplied string to lower case */
 #define lowercase(input) \
@@ -87,36 +168,561 @@ extern _kernel_oserror bad_reason, error_no_mem, error_analogue, error_calib, Fa
 
 /* ----------------------------------------------------------------------- */
 
-_kernel_oserror *FakeJoystick_initialise(const char *cmd_tail, int podule_base, void *pw)
+static unsigned int monotonic_time(void)
+{
+  _kernel_swi_regs regs;
+  if(_kernel_swi(OS_ReadMonotonicTime, &regs, &regs) != NULL)
+    return 0;
+  return (unsigned int)regs.r[0];
+}
+
+/* ----------------------------------------------------------------------- */
+
+static signed int calib_map(signed int pos, signed int centre, signed int half_span)
+{
+  /* Scale a 16-bit resolution position so that the calibrated extremes
+     span the full range (intermediate values fit in 32 bits) */
+  signed int cal = (pos - centre) * RANGE_16 / half_span;
+  if(cal > RANGE_16)
+    cal = RANGE_16;
+  if(cal < -RANGE_16)
+    cal = -RANGE_16;
+  return cal;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void calib_compile(int axis, signed int centre, signed int half_span)
+{
+  /* Precompute the mapping for one axis, so that Joystick_Read needn't */
+  for(int i = 0; i <= 256; i++)
+    calib_16[axis][i] = (unsigned short)(0x7fff + calib_map((i - 128) * 256, centre, half_span));
+
+  for(int i = 0; i < 256; i++)
+    calib_8[axis][i] = (signed char)(calib_map((i - 128) * 256, centre, half_span) / 256);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void calib_reset(void)
+{
+  calibrating = 0;
+  calib_compile(AXIS_X, 0, RANGE_16);
+  calib_compile(AXIS_Y, 0, RANGE_16);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void calib_complete(void)
+{
+  for(int axis = AXIS_X; axis <= AXIS_Y; axis++) {
+    signed int half_span = (calib_tr[axis] - calib_bl[axis]) / 2;
+    if(half_span > -256 && half_span < 256)
+      calib_compile(axis, 0, RANGE_16); /* stick didn't move far enough, so leave it alone */
+    else
+      calib_compile(axis, (calib_tr[axis] + calib_bl[axis]) / 2, half_span);
+  }
+  calibrating = 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void calib_capture(signed int pos[2])
+{
+  /* Record the current position of the emulated joystick at 16-bit resolution */
+  pos[AXIS_X] = merged_pos[AXIS_X] >> 2;
+  pos[AXIS_Y] = merged_pos[AXIS_Y] >> 2;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static unsigned int stick_state_16(int axis, signed int pos)
+{
+  /* Calibrated 16-bit value of one axis, as for Joystick_Read 1 */
+  const unsigned short *entry = &calib_16[axis][(pos >> 8) + 128];
+  signed int step = entry[1] - entry[0];
+  return entry[0] + ((step * (pos & 0xff)) >> 8);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static unsigned int merge_sources(uint32_t a, signed int dx, signed int dy, signed int pos[2])
+{
+  /* Add the keypad state a (or dx, dy if damped) to the other sources.
+     Returns the resulting state for Joystick_Read 0. */
+  unsigned int all_buttons = buttons | mouse_buttons | inject_buttons;
+
+  if(mode == MODE_DAMPED) {
+    pos[AXIS_X] = dx;
+    pos[AXIS_Y] = dy;
+  }
+  else {
+    pos[AXIS_X] = AXES_X(a) * FIXED_POINT_ONE;
+    pos[AXIS_Y] = AXES_Y(a) * FIXED_POINT_ONE;
+  }
+
+  for(int axis = AXIS_X; axis <= AXIS_Y; axis++) {
+    pos[axis] += mouse_pos[axis] + inject_pos[axis];
+    if(pos[axis] > 127 * FIXED_POINT_ONE)
+      pos[axis] = 127 * FIXED_POINT_ONE;
+    if(pos[axis] < -127 * FIXED_POINT_ONE)
+      pos[axis] = -127 * FIXED_POINT_ONE;
+  }
+
+  return (calib_8[AXIS_Y][pos[AXIS_Y] / FIXED_POINT_ONE + 128] & 0xffu) |
+         ((calib_8[AXIS_X][pos[AXIS_X] / FIXED_POINT_ONE + 128] & 0xffu) << 8) |
+         (all_buttons << 16);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void publish(void)
+{
+  /* Merge all input sources into the state returned by Joystick_Read.
+     Must be called whenever a source changes, with interrupts disabled. */
+  signed int pos[2];
+
+  published_8 = merge_sources(axes, damp_x, damp_y, pos);
+  merged_pos[AXIS_X] = pos[AXIS_X];
+  merged_pos[AXIS_Y] = pos[AXIS_Y];
+
+  /* (actual range is only 255-65279 rather than 0-65535) */
+  published_16 = stick_state_16(AXIS_Y, pos[AXIS_Y] >> 2) |
+                 (stick_state_16(AXIS_X, pos[AXIS_X] >> 2) << 16);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int irqs_disable(void)
+{
+  /* Keep interrupt handlers out whilst a source's state is inconsistent */
+  int irqs_were_off = _kernel_irqs_disabled();
+  _kernel_irqs_off();
+  return irqs_were_off;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void irqs_restore(int irqs_were_off)
+{
+  if(!irqs_were_off)
+    _kernel_irqs_on();
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void publish_foreground(void)
+{
+  /* Publish from code that interrupt handlers might otherwise interrupt */
+  int irqs_were_off = irqs_disable();
+  publish();
+  irqs_restore(irqs_were_off);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *ticker_update(char new_mode, unsigned int new_sources, void *pw)
+{
+  /* Attach or remove the OS_CallEvery routine, which is needed by the
+     analogue emulation types and to read the mouse */
+  _kernel_oserror *err = NULL;
+  _kernel_swi_regs regs;
+  bool needed = new_mode != MODE_SWITCHED || (new_sources & (1u << SOURCE_MOUSE));
+
+  if(needed && !ticker_on) {
+    regs.r[0] = 4; /* every 4 cs */
+    regs.r[1] = (intptr_t)callevery_veneer;
+    regs.r[2] = (intptr_t)pw;
+    err = _kernel_swi(OS_CallEvery, &regs, &regs);
+    if(err == NULL)
+      ticker_on = true;
+  }
+  else if(!needed && ticker_on) {
+    regs.r[0] = (intptr_t)callevery_veneer;
+    regs.r[1] = (intptr_t)pw;
+    err = _kernel_swi(OS_RemoveTickerEvent, &regs, &regs);
+    if(err == NULL)
+      ticker_on = false;
+  }
+  return err;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *keypad_enable(void *pw)
 {
-  
-  /* Reset imaginary joystick state */
-  x_axis = 0;
-  y_axis = 0;
-  buttons = 0;
-  mode = MODE_SWITCHED;
-  fake_calibrate_BL = false;
-  fake_calibrate_TR = false;
-  damp_x = 0;
-  damp_y = 0;
-  
   /* Enable key transition event */
   if(_kernel_osbyte(OSB_ENABLEEVENT,EVENT_KEYTRANS,0) == _kernel_ERROR)
     return _kernel_last_oserror(); /* fail */
 
   /* Install event routine  */
   {
-    _kernel_oserror *initerror;
+    _kernel_oserror *err;
     _kernel_swi_regs regs;
     regs.r[0] = VECTOR_EVENTV;
     regs.r[1] = (intptr_t)&event_veneer;
     regs.r[2] = (intptr_t)pw;
-    initerror = _kernel_swi(OS_Claim, &regs, &regs);
-    if(initerror != NULL) {
+    err = _kernel_swi(OS_Claim, &regs, &regs);
+    if(err != NULL) {
       _kernel_osbyte(OSB_DISABLEEVENT,EVENT_KEYTRANS,0); /* Refuse to live if we can't claim event vector */
-      return initerror; /* fail */
+      return err; /* fail */
     }
   }
+  sources |= 1u << SOURCE_KEYPAD;
+  return NULL; /* success */
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *keypad_disable(void *pw)
+{
+  _kernel_swi_regs regs;
+  _kernel_oserror *err;
+
+  /* Disable key transition event */
+  if(_kernel_osbyte(OSB_DISABLEEVENT,EVENT_KEYTRANS,0)==_kernel_ERROR)
+     return _kernel_last_oserror(); /* fail */
+
+  /* Remove event handler */
+  regs.r[0] = VECTOR_EVENTV;
+  regs.r[1] = (intptr_t)&event_veneer;
+  regs.r[2] = (intptr_t)pw;
+  err = _kernel_swi(OS_Release, &regs, &regs);
+  if(err != NULL)
+    return err; /* fail */
+
+  /* Keys can no longer be released, so forget them. The ticker would step
+     the stick off centre again if it saw keys still pressed. */
+  {
+    int irqs_were_off = irqs_disable();
+    sources &= ~(1u << SOURCE_KEYPAD);
+    keys = 0;
+    axes = AXES_CENTRE;
+    buttons = 0;
+    damp_x = 0;
+    damp_y = 0;
+    latency_pending = false;
+    publish();
+    irqs_restore(irqs_were_off);
+  }
+  return NULL; /* success */
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *mouse_enable(void *pw)
+{
+  _kernel_swi_regs regs;
+  _kernel_oserror *err;
+
+  /* Movement is measured from the current pointer position */
+  err = _kernel_swi(OS_Mouse, &regs, &regs);
+  if(err != NULL)
+    return err; /* fail */
+
+  mouse_home[AXIS_X] = regs.r[0];
+  mouse_home[AXIS_Y] = regs.r[1];
+  mouse_pos[AXIS_X] = 0;
+  mouse_pos[AXIS_Y] = 0;
+  mouse_buttons = 0;
+  err = ticker_update(mode, sources | (1u << SOURCE_MOUSE), pw);
+  if(err != NULL)
+    return err; /* fail */
+
+  sources |= 1u << SOURCE_MOUSE;
+  return NULL; /* success */
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *callback_remove(void *pw)
+{
+  /* Remove transient callback routine, if the ticker has added it */
+  _kernel_swi_regs regs;
+  _kernel_oserror *err;
+
+  if(!callback_pending)
+    return NULL; /* success */
+
+  regs.r[0] = (intptr_t)callback_veneer;
+  regs.r[1] = (intptr_t)pw;
+  err = _kernel_swi(OS_RemoveCallBack, &regs, &regs);
+  if(err != NULL)
+    return err; /* fail */
+
+  callback_pending = false;
+  return NULL; /* success */
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *mouse_disable(void *pw)
+{
+  _kernel_oserror *err;
+
+  /* Stop the ticker adding a callback before removing any pending one,
+     otherwise it could add another in between */
+  sources &= ~(1u << SOURCE_MOUSE);
+
+  err = callback_remove(pw);
+  if(err == NULL)
+    err = ticker_update(mode, sources, pw);
+  if(err != NULL) {
+    sources |= 1u << SOURCE_MOUSE;
+    return err; /* fail */
+  }
+
+  {
+    int irqs_were_off = irqs_disable();
+    mouse_pos[AXIS_X] = 0;
+    mouse_pos[AXIS_Y] = 0;
+    mouse_buttons = 0;
+    publish();
+    irqs_restore(irqs_were_off);
+  }
+  return NULL; /* success */
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void inject_reset(void)
+{
+  /* Forget injected state */
+  int irqs_were_off = irqs_disable();
+  inject_pos[AXIS_X] = 0;
+  inject_pos[AXIS_Y] = 0;
+  inject_buttons = 0;
+  publish();
+  irqs_restore(irqs_were_off);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *inject_enable(void *pw)
+{
+  /* Nothing to claim: values arrive via Joystick_FakeInject */
+  (void)pw;
+  inject_reset();
+  sources |= 1u << SOURCE_INJECT;
+  return NULL; /* success */
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *inject_disable(void *pw)
+{
+  (void)pw;
+  sources &= ~(1u << SOURCE_INJECT);
+  inject_reset();
+  return NULL; /* success */
+}
+
+/* ----------------------------------------------------------------------- */
+
+static const struct {
+  const char *name;
+  _kernel_oserror *(*enable)(void *pw);
+  _kernel_oserror *(*disable)(void *pw);
+} source_table[SOURCE_COUNT] = {
+  { "keypad", keypad_enable, keypad_disable }, /* SOURCE_KEYPAD */
+  { "mouse",  mouse_enable,  mouse_disable  }, /* SOURCE_MOUSE */
+  { "inject", inject_enable, inject_disable }  /* SOURCE_INJECT */
+};
+
+/* ----------------------------------------------------------------------- */
+
+static uint32_t axes_saturate(uint32_t a)
+{
+  /* Clamp both lanes to -127..+127 without branching. Adding a constant
+     that takes a lane to 0x8000 exactly at the limit leaves the verdict in
+     bit 15 of that lane, which is spread into a whole-lane mask. */
+  uint32_t over  = ((a + AXES_LANES * (0x8000 - (AXIS_BIAS + 128))) >> 15) & AXES_LANES;
+  uint32_t under = (~(a + AXES_LANES * (0x8000 - (AXIS_BIAS - 127))) >> 15) & AXES_LANES;
+  over *= 0xffffu;
+  under *= 0xffffu;
+  return (a & ~(over | under)) | (AXES_MAX & over) | (AXES_MIN & under);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static uint32_t analogue_step(uint32_t a, uint32_t k)
+{
+  /* Move both axes according to keys k, saturating after each half so that
+     opposing keys held together behave as if applied in turn */
+  a -= (k & KEYS_LEFT) * AXIS_STEP;
+  a += (k & KEYS_UP) * AXIS_STEP;
+  a = axes_saturate(a);
+  a += ((k & KEYS_RIGHT) >> 1) * AXIS_STEP;
+  a -= ((k & KEYS_DOWN) >> 1) * AXIS_STEP;
+  return axes_saturate(a);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void damped_step(signed int *dx, signed int *dy, uint32_t k)
+{
+  signed int x = *dx, y = *dy;
+
+  /* Gradual decay function */
+  x = x - (x / DECAY_DIVISOR_A) - (x / DECAY_DIVISOR_B);
+  y = y - (y / DECAY_DIVISOR_A) - (y / DECAY_DIVISOR_B);
+  
+  /* move stick according to keys k */
+  if(k & KEYS_LEFT) {
+    x -= 15 * FIXED_POINT_ONE;
+    if(x >= 0)
+      x -= x / REVERSE_DIRECTION_BOOST;
+    if(x < -127 * FIXED_POINT_ONE)
+      x = -127 * FIXED_POINT_ONE;
+  }
+  if(k & KEYS_RIGHT) {
+    x += 15 * FIXED_POINT_ONE;
+    if(x < 0)
+      x -= x / REVERSE_DIRECTION_BOOST;
+    if(x > 127 * FIXED_POINT_ONE)
+      x = 127 * FIXED_POINT_ONE;
+  }
+  if(k & KEYS_UP) {
+    y += 15 * FIXED_POINT_ONE;
+    if(y < 0)
+      y -= y / REVERSE_DIRECTION_BOOST;
+    if(y > 127 * FIXED_POINT_ONE)
+      y = 127 * FIXED_POINT_ONE;
+  }
+  if(k & KEYS_DOWN) {
+    y -= 15 * FIXED_POINT_ONE;
+    if(y >= 0)
+      y -= y / REVERSE_DIRECTION_BOOST;
+    if(y < -127 * FIXED_POINT_ONE)
+      y = -127 * FIXED_POINT_ONE;
+  }
+  *dx = x;
+  *dy = y;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static unsigned int latency_predict(uint32_t k)
+{
+  /* State for Joystick_Read 0 after the next tick, if keys k are held */
+  uint32_t a = axes;
+  signed int dx = damp_x, dy = damp_y;
+  signed int pos[2];
+
+  if(mode == MODE_DAMPED)
+    damped_step(&dx, &dy, k);
+  else if(mode == MODE_ANALOGUE)
+    a = analogue_step(a, k);
+
+  return merge_sources(a, dx, dy, pos);
+}
+
+/* ----------------------------------------------------------------------- */
+
+/* Signed 8-bit axis value at bit 'shift' of a Joystick_Read 0 state */
+#define STATE_AXIS(state, shift) ((signed int)((((state) >> (shift)) & 0xffu) ^ 0x80u) - 0x80)
+
+static bool latency_seen(unsigned int state)
+{
+  /* Does state show the change from latency_before to latency_after?
+     Axes count once they reach or pass the predicted value, since other
+     movement (e.g. decay) may carry on before the next read. */
+  unsigned int changed_buttons = (latency_before ^ latency_after) & 0xff0000u;
+
+  for(int shift = 0; shift <= 8; shift += 8) {
+    signed int from = STATE_AXIS(latency_before, shift);
+    signed int to = STATE_AXIS(latency_after, shift);
+    signed int now = STATE_AXIS(state, shift);
+    if((to > from && now < to) || (to < from && now > to))
+      return false;
+  }
+  return (state & changed_buttons) == (latency_after & changed_buttons);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void latency_check(void)
+{
+  /* Called by Joystick_Read whilst a key event awaits its first visible effect */
+  unsigned int elapsed = monotonic_time() - latency_time;
+
+  if(latency_seen(published_8)) {
+    if(elapsed > LATENCY_BUCKETS)
+      elapsed = LATENCY_BUCKETS; /* overflow bucket */
+    latency_hist[(int)latency_mode][elapsed]++;
+    latency_pending = false;
+  }
+  else if(elapsed > LATENCY_TIMEOUT) {
+    /* Predicted effect didn't appear, e.g. because it was undone */
+    latency_lost[(int)latency_mode]++;
+    latency_pending = false;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void latency_print(FILE *f)
+{
+  /* Write the latency histogram in a form that is readable by humans and
+     easily parsed by other programs */
+  static const char *const mode_names[MODE_COUNT] = {"switched", "analogue", "damped"};
+
+  fprintf(f, "# Joystick_Read latency (cs)\n# cs");
+  for(int m = 0; m < MODE_COUNT; m++)
+    fprintf(f, " %s", mode_names[m]);
+  fprintf(f, "\n");
+
+  for(int b = 0; b <= LATENCY_BUCKETS; b++) {
+    bool used = false;
+    for(int m = 0; m < MODE_COUNT; m++)
+      if(latency_hist[m][b] != 0)
+        used = true;
+    if(!used)
+      continue; /* omit empty rows */
+
+    fprintf(f, b < LATENCY_BUCKETS ? "%d" : ">=%d", b);
+    for(int m = 0; m < MODE_COUNT; m++)
+      fprintf(f, " %u", latency_hist[m][b]);
+    fprintf(f, "\n");
+  }
+
+  fprintf(f, "lost");
+  for(int m = 0; m < MODE_COUNT; m++)
+    fprintf(f, " %u", latency_lost[m]);
+  fprintf(f, "\n");
+}
+
+/* ----------------------------------------------------------------------- */
+
+_kernel_oserror *FakeJoystick_initialise(const char *cmd_tail, int podule_base, void *pw)
+{
+  
+  /* Reset imaginary joystick state */
+  axes = AXES_CENTRE;
+  keys = 0;
+  buttons = 0;
+  mode = MODE_SWITCHED;
+  calib_reset();
+  damp_x = 0;
+  damp_y = 0;
+  latency_enabled = false;
+  latency_pending = false;
+  memset(latency_hist, 0, sizeof(latency_hist));
+  memset(latency_lost, 0, sizeof(latency_lost));
+  ticker_on = false;
+  callback_pending = false;
+  mouse_gain = MOUSE_GAIN_DEFAULT;
+  sources = 0;
+  
+  /* Keypad and Joystick_FakeInject are available by default */
+  {
+    _kernel_oserror *initerror = keypad_enable(pw);
+    if(initerror != NULL)
+      return initerror; /* fail */
+  }
+  inject_enable(pw);
+
+  publish();
   return NULL; /* success */
 }
 
@@ -124,14 +730,14 @@ _kernel_oserror *FakeJoystick_initialise(const char *cmd_tail, int podule_base,
 
 _kernel_oserror *cmd_handler(const char *arg_string, int argc, int cmd_no, void *pw)
 {
-  #define MAXARGS 1
+  #define MAXARGS 3
   char *writeable_args;
   char *arg_ptrs[MAXARGS];
   int argcount = 0;
 
   /* Don't think we can get spurious commands, but just in case.... */
   /*printf("cmd_no: %d\nargc: %d\n",cmd_no,argc);*/
-  if(cmd_no != CMD_FakeJSType)
+  if(cmd_no != CMD_FakeJSType && cmd_no != CMD_FakeJSLatency && cmd_no != CMD_FakeJSSource)
     return NULL; /* success */
 
   if (argc > MAXARGS)
@@ -166,60 +772,130 @@ _kernel_oserror *cmd_handler(const char *arg_string, int argc, int cmd_no, void
     }
   }
 
+  if(cmd_no == CMD_FakeJSLatency) {
+    /* FakeJSLatency [on|off|reset|save <filename>] */
+    _kernel_oserror *cmd_error = NULL;
+
+    if(argcount > 0) {
+      lowercase(arg_ptrs[0]);
+      if(strcmp(arg_ptrs[0], "on") == 0 && argcount == 1) {
+        latency_pending = false;
+        latency_enabled = true;
+      } else {
+        if(strcmp(arg_ptrs[0], "off") == 0 && argcount == 1) {
+          latency_enabled = false;
+          latency_pending = false;
+        } else {
+          if(strcmp(arg_ptrs[0], "reset") == 0 && argcount == 1) {
+            latency_pending = false;
+            memset(latency_hist, 0, sizeof(latency_hist));
+            memset(latency_lost, 0, sizeof(latency_lost));
+          } else {
+            if(strcmp(arg_ptrs[0], "save") == 0 && argcount == 2) {
+              FILE *f = fopen(arg_ptrs[1], "w");
+              if(f == NULL)
+                cmd_error = &error_save;
+              else {
+                latency_print(f);
+                if(fclose(f) != 0)
+                  cmd_error = &error_save;
+              }
+            } else
+              cmd_error = &FakeJSLatency_syntax;
+          }
+        }
+      }
+    }
+    else {
+      /* display current histogram */
+      printf("Latency measurement: %s\n", latency_enabled ? "On" : "Off");
+      latency_print(stdout);
+    }
+    free(writeable_args);
+    return cmd_error;
+  }
+
+  if(cmd_no == CMD_FakeJSSource) {
+    /* FakeJSSource [keypad|mouse|inject on|off [<gain>]] */
+    _kernel_oserror *cmd_error = NULL;
+
+    if(argcount > 0) {
+      int src = 0;
+      lowercase(arg_ptrs[0]);
+      while(src < SOURCE_COUNT && strcmp(arg_ptrs[0], source_table[src].name) != 0)
+        src++;
+
+      if(src == SOURCE_COUNT || argcount < 2)
+        cmd_error = &FakeJSSource_syntax;
+      else {
+        lowercase(arg_ptrs[1]);
+        if(strcmp(arg_ptrs[1], "on") == 0) {
+          if(argcount > 2) {
+            /* Only the mouse has a gain (16-bit counts per OS unit) */
+            char *end;
+            unsigned long gain = strtoul(arg_ptrs[2], &end, 10);
+            if(src != SOURCE_MOUSE || *end != '\0' || gain < 1 || gain > MOUSE_GAIN_MAX)
+              cmd_error = &FakeJSSource_syntax;
+            else
+              mouse_gain = (unsigned int)gain;
+          }
+          if(cmd_error == NULL && !(sources & (1u << src)))
+            cmd_error = source_table[src].enable(pw);
+        } else {
+          if(strcmp(arg_ptrs[1], "off") == 0 && argcount == 2) {
+            if(sources & (1u << src))
+              cmd_error = source_table[src].disable(pw);
+          } else
+            cmd_error = &FakeJSSource_syntax;
+        }
+        if(cmd_error == NULL)
+          publish_foreground();
+      }
+    }
+    else {
+      /* display current setting */
+      printf("Input sources:");
+      for(int src = 0; src < SOURCE_COUNT; src++)
+        printf(" %s %s", source_table[src].name, (sources & (1u << src)) ? "on" : "off");
+      printf("\nMouse gain: %u\n", mouse_gain);
+    }
+    free(writeable_args);
+    return cmd_error;
+  }
+
   {
     /* FakeJSType [analogue|switched|damped] */
     _kernel_oserror *cmd_error = NULL;
 
     if(argcount > 0) {
       /* set emulation type */
+      char new_mode = MODE_SWITCHED;
       lowercase(arg_ptrs[0]);
       if(strcmp(arg_ptrs[0], "switched") == 0) {
-        if(mode != MODE_SWITCHED) {
-          /* Remove OS_CallEvery routine */
-          _kernel_swi_regs regs;
-          regs.r[0] = (intptr_t)callevery_veneer;
-          regs.r[1] = (intptr_t)pw;
-          cmd_error = _kernel_swi(OS_RemoveTickerEvent, &regs,&regs);
-          if(cmd_error == NULL)
-            mode = MODE_SWITCHED;
-        }
+        new_mode = MODE_SWITCHED;
       } else {
         if(strcmp(arg_ptrs[0], "analogue") == 0) {
-          if(mode == MODE_SWITCHED) {
-            /* Attach OS_CallEvery routine */
-            _kernel_swi_regs regs;
-            regs.r[0] = 4; /* every 4 cs */
-            regs.r[1] = (intptr_t)callevery_veneer;
-            regs.r[2] = (intptr_t)pw;
-            cmd_error = _kernel_swi(OS_CallEvery, &regs, &regs);
-          }
-          if(cmd_error == NULL)
-            mode = MODE_ANALOGUE;
+          new_mode = MODE_ANALOGUE;
         } else {
           if(strcmp(arg_ptrs[0], "damped") == 0) {
-            if(mode == MODE_SWITCHED) {
-              /* Attach OS_CallEvery routine */
-              _kernel_swi_regs regs;
-              regs.r[0] = 4; /* every 4 cs */
-              regs.r[1] = (intptr_t)callevery_veneer;
-              regs.r[2] = (intptr_t)pw;
-              cmd_error = _kernel_swi(OS_CallEvery, &regs, &regs);
-            }
-            if(cmd_error == NULL) {
-              mode = MODE_DAMPED;
-              damp_x = 0;
-              damp_y = 0;
-            }
+            new_mode = MODE_DAMPED;
           } else
             cmd_error = &FakeJSType_syntax;
         }
       }
+      if(cmd_error == NULL) {
+        /* Attach or remove OS_CallEvery routine */
+        cmd_error = ticker_update(new_mode, sources, pw);
+      }
       if(cmd_error == NULL) {
         /* Changing emulation type (reset) */
-        x_axis = 0;
-        y_axis = 0;
-        fake_calibrate_BL = false;
-        fake_calibrate_TR = false;
+        mode = new_mode;
+        axes = AXES_CENTRE;
+        damp_x = 0;
+        damp_y = 0;
+        calib_reset();
+        latency_pending = false;
+        publish_foreground();
       }
     }
     else {
@@ -252,23 +928,23 @@ _kernel_oserror *FakeJoystick_swihandler(int swi_no, _kernel_swi_regs *r, void *
   switch(swi_no) {
   
     case 0: /* Joystick_Read */
-      if(fake_calibrate_TR || fake_calibrate_BL)
+      if(calibrating)
         return &error_calib; /* fail */
       {
         char stick_num = r->r[0] & 0xff;
         char reason_code = (r->r[0] & 0xff00) >> 8;
         if(stick_num == 0) {
           /* first joystick is emulated */
+          if(latency_pending)
+            latency_check();
+
           switch(reason_code) {
 
             case 0:
               /* Read 8-bit state of an analogue or switched joystick*/
               if(stick_num == 0) {
                 /* first joystick is emulated */
-                if(mode == MODE_DAMPED)
-                  r->r[0] = ((damp_y / FIXED_POINT_ONE) & 0xffu) | (((damp_x / FIXED_POINT_ONE) & 0xffu) << 8) | (buttons << 16);
-                else
-                  r->r[0] = (y_axis & 0xff) | ((x_axis & 0xffu) << 8) | (buttons << 16);
+                r->r[0] = published_8;
               }
               else {
                 /* other joysticks aren't */
@@ -282,18 +958,8 @@ _kernel_oserror *FakeJoystick_swihandler(int swi_no, _kernel_swi_regs *r, void *
                 return &error_analogue; /* Analogue sticks only */  
               if(stick_num == 0) {
                 /* first joystick is emulated */
-                signed int x_16, y_16;
-                if(mode == MODE_DAMPED) {
-                  x_16 = 0x7fff + (damp_x >> 2);
-                  y_16 = 0x7fff + (damp_y >> 2);
-                }
-                else {
-                  x_16 = 0x7fff + ((signed int)x_axis << 8);
-                  y_16 = 0x7fff + ((signed int)y_axis << 8);
-                }
-                /* (actual range is only 255-65279 rather than 0-65535) */
-                r->r[0] = (y_16 & 0xffff) | ((x_16 & 0xffff) << 16);
-                r->r[1] = buttons; /* switch state */
+                r->r[0] = published_16;
+                r->r[1] = published_8 >> 16; /* switch state */
               }
               else {
                 /* other joysticks aren't */
@@ -314,10 +980,13 @@ _kernel_oserror *FakeJoystick_swihandler(int swi_no, _kernel_swi_regs *r, void *
       if(mode == MODE_SWITCHED)
         return &error_analogue; /* Analogue sticks only */
       else {
-        if(!fake_calibrate_BL)
-          fake_calibrate_TR = true; /* calibration incomplete */
-        else
-          fake_calibrate_BL = false; /* calibration complete */
+        calib_capture(calib_tr);
+        if(calibrating != CALIB_AWAIT_TR)
+          calibrating = CALIB_AWAIT_BL; /* calibration incomplete */
+        else {
+          calib_complete();
+          publish_foreground();
+        }
         return NULL; /* success */
       }
       
@@ -325,12 +994,56 @@ _kernel_oserror *FakeJoystick_swihandler(int swi_no, _kernel_swi_regs *r, void *
       if(mode == MODE_SWITCHED)
         return &error_analogue; /* Analogue sticks only */
       else {
-        if(!fake_calibrate_TR)
-          fake_calibrate_BL = true; /* calibration incomplete */
-        else
-          fake_calibrate_TR = false; /* calibration complete */
+        calib_capture(calib_bl);
+        if(calibrating != CALIB_AWAIT_BL)
+          calibrating = CALIB_AWAIT_TR; /* calibration incomplete */
+        else {
+          calib_complete();
+          publish_foreground();
+        }
         return NULL; /* success */
       }
+
+    case 3: /* Joystick_FakeInject */
+      if(!(sources & (1u << SOURCE_INJECT)))
+        return &error_source; /* fail */
+      {
+        char stick_num = r->r[0] & 0xff;
+        char reason_code = (r->r[0] & 0xff00) >> 8;
+        if(stick_num != 0)
+          return &error_stick; /* only the first joystick is emulated */
+
+        signed int x = 0, y = 0;
+        unsigned char new_buttons = 0;
+        int irqs_were_off;
+
+        switch(reason_code) {
+
+          case 0:
+            /* Set 16-bit state, in the same format as Joystick_Read 1 */
+            y = ((signed int)(r->r[1] & 0xffff) - 0x7fff) * (FIXED_POINT_ONE / 256);
+            x = ((signed int)((r->r[1] >> 16) & 0xffff) - 0x7fff) * (FIXED_POINT_ONE / 256);
+            new_buttons = r->r[2] & 0xff;
+            break;
+
+          case 1:
+            /* Release joystick */
+            break;
+
+          default:
+            /* Unknown reason code! */
+            return &bad_reason; /* fail */
+        }
+
+        /* The ticker mustn't publish a mixture of old and new state */
+        irqs_were_off = irqs_disable();
+        inject_pos[AXIS_X] = x;
+        inject_pos[AXIS_Y] = y;
+        inject_buttons = new_buttons;
+        publish();
+        irqs_restore(irqs_were_off);
+      }
+      return NULL; /* success */
       
     default:
       return error_BAD_SWI; /* fail */
@@ -343,6 +1056,23 @@ int event_handler(_kernel_swi_regs *r, void *pw)
 {
   /* (no need to check event number, as CMHG veneer filters events for us) */
   
+  switch(r->r[2]) {
+    case KEY_KP4:
+    case KEY_KP6:
+    case KEY_KP5:
+    case KEY_KP8:
+    case KEY_KP2:
+    case KEY_KPENTER:
+    case KEY_KPPLUS:
+      break;
+
+    default:
+      return 1; /* not one of our keys */
+  }
+
+  uint32_t old_keys = keys;
+  unsigned int before = published_8;
+
   switch(r->r[2]) {
     /* Check fire buttons */
     case KEY_KPENTER:
@@ -374,56 +1104,55 @@ int event_handler(_kernel_swi_regs *r, void *pw)
       case KEY_KP4:
         if(r->r[1]) {
           /* press */
-          x_axis = -64;
+          AXES_SET_X(axes, -64);
         }
         else {
           /* release */
-          if(x_axis < 0)
-            x_axis = 0;
+          if(AXES_X(axes) < 0)
+            AXES_SET_X(axes, 0);
         }
         break;
         
       case KEY_KP6:
         if(r->r[1]) {
           /* press */
-          x_axis = 64;
+          AXES_SET_X(axes, 64);
         }
         else {
           /* release */
-          if(x_axis > 0)
-            x_axis = 0;
+          if(AXES_X(axes) > 0)
+            AXES_SET_X(axes, 0);
         }
         break;
         
       case KEY_KP8:
         if(r->r[1]) {
           /* press */
-          y_axis = 64;
+          AXES_SET_Y(axes, 64);
         }
         else {
           /* release */
-          if(y_axis > 0)
-            y_axis = 0;
+          if(AXES_Y(axes) > 0)
+            AXES_SET_Y(axes, 0);
         }
         break;
         
       case KEY_KP2:
         if(r->r[1]) {
           /* press */
-          y_axis = -64;
+          AXES_SET_Y(axes, -64);
         }
         else {
           /* release */
-          if(y_axis < 0)
-            y_axis = 0;
+          if(AXES_Y(axes) < 0)
+            AXES_SET_Y(axes, 0);
         }
         break;
         
       case KEY_KP5:
         if(r->r[1]) {
           /* press */
-          x_axis = 0;
-          y_axis = 0;
+          axes = AXES_CENTRE;
         }
         break;
       }
@@ -431,32 +1160,63 @@ int event_handler(_kernel_swi_regs *r, void *pw)
     /* emulate analogue stick - which key is it? */
     switch(r->r[2]) {
       case KEY_KP4:
-        left = r->r[1];
+        if(r->r[1])
+          keys |= KEYS_LEFT;
+        else
+          keys &= ~KEYS_LEFT;
         break;
         
       case KEY_KP6:
-        right = r->r[1];
+        if(r->r[1])
+          keys |= KEYS_RIGHT;
+        else
+          keys &= ~KEYS_RIGHT;
         break;
         
       case KEY_KP8:
-        up = r->r[1];
+        if(r->r[1])
+          keys |= KEYS_UP;
+        else
+          keys &= ~KEYS_UP;
         break;
         
       case KEY_KP2:
-        down = r->r[1];
+        if(r->r[1])
+          keys |= KEYS_DOWN;
+        else
+          keys &= ~KEYS_DOWN;
         break;
         
       case KEY_KP5:
         if(r->r[1]) {
           /* press */
-          x_axis = 0;
-          y_axis = 0;
+          axes = AXES_CENTRE;
           damp_x = 0;
           damp_y = 0;
         }
         break;
     }
   }
+  publish();
+
+  if(latency_enabled && !latency_pending) {
+    /* Time from the first unseen key transition to its first visible
+       effect, ignoring transitions that won't change the state */
+    unsigned int after = published_8;
+    if(after == before && keys != old_keys) {
+      /* Direction keys only move an analogue stick at the next tick */
+      unsigned int next = latency_predict(keys);
+      if(next != latency_predict(old_keys))
+        after = next;
+    }
+    if(after != before) {
+      latency_time = monotonic_time();
+      latency_before = before;
+      latency_after = after;
+      latency_mode = mode;
+      latency_pending = true;
+    }
+  }
   return 1;  /* pass event on to next claimant */
 }
 
@@ -465,97 +1225,100 @@ int event_handler(_kernel_swi_regs *r, void *pw)
 _kernel_oserror *callevery_handler(_kernel_swi_regs *r, void *pw)
 {
   /* Called every 4 cs (25 times a second) */
+  if((sources & (1u << SOURCE_MOUSE)) && !callback_pending) {
+    /* Read the pointer when RISC OS is next not busy */
+    _kernel_swi_regs regs;
+    regs.r[0] = (intptr_t)callback_veneer;
+    regs.r[1] = (intptr_t)pw;
+    if(_kernel_swi(OS_AddCallBack, &regs, &regs) == NULL)
+      callback_pending = true;
+  }
+
   if(mode == MODE_DAMPED) {
-  
-    /* Gradual decay function */
-    damp_x = damp_x - (damp_x / DECAY_DIVISOR_A) - (damp_x / DECAY_DIVISOR_B);
-    damp_y = damp_y - (damp_y / DECAY_DIVISOR_A) - (damp_y / DECAY_DIVISOR_B);
-    
+    /* decay and move stick according to keys */
+    damped_step(&damp_x, &damp_y, keys);
+  } else if(mode == MODE_ANALOGUE) {
     /* move stick according to keys */
-    if(left) {
-      damp_x -= 15 * FIXED_POINT_ONE;
-      if(damp_x >= 0)
-        damp_x -= damp_x / REVERSE_DIRECTION_BOOST;
-      if(damp_x < -127 * FIXED_POINT_ONE)
-        damp_x = -127 * FIXED_POINT_ONE;
-    }
-    if(right) {
-      damp_x += 15 * FIXED_POINT_ONE;
-      if(damp_x < 0)
-        damp_x -= damp_x / REVERSE_DIRECTION_BOOST;
-      if(damp_x > 127 * FIXED_POINT_ONE)
-        damp_x = 127 * FIXED_POINT_ONE;
-    }
-    if(up) {
-      damp_y += 15 * FIXED_POINT_ONE;
-      if(damp_y < 0)
-        damp_y -= damp_y / REVERSE_DIRECTION_BOOST;
-      if(damp_y > 127 * FIXED_POINT_ONE)
-        damp_y = 127 * FIXED_POINT_ONE;
-    }
-    if(down) {
-      damp_y -= 15 * FIXED_POINT_ONE;
-      if(damp_y >= 0)
-        damp_y -= damp_y / REVERSE_DIRECTION_BOOST;
-      if(damp_y < -127 * FIXED_POINT_ONE)
-        damp_y = -127 * FIXED_POINT_ONE;
-    }
-  } else {
-    /* move stick according to keys */
-    if(left) {
-      if(x_axis > -123)
-        x_axis -= 5;
-      else
-        x_axis = -127;
-    }
-    if(right) {
-      if(x_axis < 123)
-        x_axis += 5;
-      else
-        x_axis = 127;
-    }
-    if(up) {
-      if(y_axis < 123)
-        y_axis += 5;
-      else
-        y_axis = 127;
-    }
-    if(down) {
-      if(y_axis > -123)
-        y_axis -= 5;
-      else
-        y_axis = -127;
-    }
+    axes = analogue_step(axes, keys);
     /* Should traverse full range in 2 seconds (254/5 = 50) */
   }
+  publish();
   return NULL; /* success */
 }
 
 /* ----------------------------------------------------------------------- */
 
-_kernel_oserror *FakeJoystick_finalise(int fatal, int podule, void *pw)
+static bool mouse_recentre(void)
+{
+  /* Return the pointer to its home position, so that the edges of the
+     screen don't limit how far the mouse can move the stick */
+  int block[2]; /* word-aligned */
+  unsigned char *params = (unsigned char *)block;
+  params[0] = POINTER_SETMOUSE;
+  params[1] = mouse_home[AXIS_X] & 0xff;
+  params[2] = (mouse_home[AXIS_X] >> 8) & 0xff;
+  params[3] = mouse_home[AXIS_Y] & 0xff;
+  params[4] = (mouse_home[AXIS_Y] >> 8) & 0xff;
+  return _kernel_osword(OSW_POINTER, block) != _kernel_ERROR;
+}
+
+/* ----------------------------------------------------------------------- */
+
+_kernel_oserror *callback_handler(_kernel_swi_regs *r, void *pw)
 {
+  /* Called back after callevery_handler asked to read the pointer */
   _kernel_swi_regs regs;
+  int irqs_were_off;
+  bool recentred;
+  callback_pending = false;
+
+  if(!(sources & (1u << SOURCE_MOUSE)))
+    return NULL; /* mouse disabled since */
+
+  if(_kernel_swi(OS_Mouse, &regs, &regs) != NULL)
+    return NULL; /* try again next time */
+
+  /* Accumulate pointer movement away from home (R0 = x, R1 = y) */
+  recentred = mouse_recentre();
+  irqs_were_off = irqs_disable();
+  for(int axis = AXIS_X; axis <= AXIS_Y; axis++) {
+    mouse_pos[axis] += (regs.r[axis] - mouse_home[axis]) * (signed int)mouse_gain * (FIXED_POINT_ONE / 256);
+    if(!recentred)
+      mouse_home[axis] = regs.r[axis]; /* measure from here next time */
+    if(mouse_pos[axis] > 127 * FIXED_POINT_ONE)
+      mouse_pos[axis] = 127 * FIXED_POINT_ONE;
+    if(mouse_pos[axis] < -127 * FIXED_POINT_ONE)
+      mouse_pos[axis] = -127 * FIXED_POINT_ONE;
+  }
+
+  /* Select is fire button A and Adjust is fire button B */
+  mouse_buttons = ((regs.r[2] & 4) ? 1u<<0 : 0) | ((regs.r[2] & 1) ? 1u<<1 : 0);
+
+  publish();
+  irqs_restore(irqs_were_off);
+  return NULL; /* success */
+}
+
+/* ----------------------------------------------------------------------- */
+
+_kernel_oserror *FakeJoystick_finalise(int fatal, int podule, void *pw)
+{
   _kernel_oserror *err;
-  
-  /* Disable key transition event */
-  if(_kernel_osbyte(OSB_DISABLEEVENT,EVENT_KEYTRANS,0)==_kernel_ERROR)
-     return _kernel_last_oserror(); /* fail */
 
-  /* Remove event handler */
-  regs.r[0] = VECTOR_EVENTV;
-  regs.r[1] = (intptr_t)&event_veneer;
-  regs.r[2] = (intptr_t)pw;
-  err = _kernel_swi(OS_Release, &regs, &regs);
+  /* Release whatever the input sources have claimed */
+  for(int src = 0; src < SOURCE_COUNT; src++) {
+    if(sources & (1u << src)) {
+      err = source_table[src].disable(pw);
+      if(err != NULL)
+        return err; /* fail */
+    }
+  }
+
+  /* Remove OS_CallEvery routine */
+  err = ticker_update(MODE_SWITCHED, sources, pw);
   if(err != NULL)
     return err; /* fail */
 
-  if(mode != MODE_SWITCHED) {
-    /* Remove OS_CallEvery routine */
-    regs.r[0] = (intptr_t)callevery_veneer;
-    regs.r[1] = (intptr_t)pw;
-    return _kernel_swi(OS_RemoveTickerEvent, &regs, &regs);
-  }
-  else
-    return NULL; /* success */
+  /* Nothing can add a callback now, so remove any still pending last */
+  return callback_remove(pw);
 }
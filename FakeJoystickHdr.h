@@ -86,6 +86,8 @@ _kernel_oserror *FakeJoystick_finalise(int fatal, int podule, void *pw);
 #define configure_TOO_MANY_PARAMS ((_kernel_oserror *) 3)
 
 #define CMD_FakeJSType                  0
+#define CMD_FakeJSLatency               1
+#define CMD_FakeJSSource                2
 
 _kernel_oserror *cmd_handler(const char *arg_string, int argc, int cmd_no, void *pw);
 
@@ -113,6 +115,7 @@ _kernel_oserror *cmd_handler(const char *arg_string, int argc, int cmd_no, void
 #define Joystick_Read                   0x043f40
 #define Joystick_CalibrateTopRight      0x043f41
 #define Joystick_CalibrateBottomLeft    0x043f42
+#define Joystick_FakeInject             0x043f43
 #endif
 
 #define error_BAD_SWI ((_kernel_oserror *) -1)
@@ -134,6 +137,7 @@ _kernel_oserror *FakeJoystick_swihandler(int swi_offset, _kernel_swi_regs *r, vo
  * R14 are corrupted.
  */
 extern void callevery_veneer(void);
+extern void callback_veneer(void);
 
 /*
  * This is the handler function that the veneer declared above
@@ -151,6 +155,7 @@ extern void callevery_veneer(void);
  * entry veneer is called.
  */
 _kernel_oserror *callevery_handler(_kernel_swi_regs *r, void *pw);
+_kernel_oserror *callback_handler(_kernel_swi_regs *r, void *pw);
 
 
 /*
@@ -0,0 +1,158 @@
+/*
+ *  FakeJoystick - joystick emulation module
+ *  Copyright (C) 2002  Chris Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ANSI headers */
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Acorn headers */
+#include "kernel.h"
+#include "swis.h"
+
+/* CMHG header */
+#include "FakeJoystickHdr.h"
+
+#include "Stubs.h"
+
+int stub_mouse_x, stub_mouse_y, stub_mouse_buttons, stub_recentres;
+unsigned int stub_time;
+int stub_tickers, stub_callbacks;
+bool stub_irqs_off;
+void (*stub_interrupt)(void);
+
+/* Error blocks normally assembled from errors.a */
+_kernel_oserror error_no_mem = { 0x81A720, "Joystick module cannot claim memory" };
+_kernel_oserror bad_reason = { 0x81A730, "Joystick reason code not supported" };
+_kernel_oserror error_analogue = { 0x81A731, "Operation not supported for switched joystick" };
+_kernel_oserror error_calib = { 0x81A732, "Joystick calibration incomplete" };
+_kernel_oserror error_save = { 0x81A733, "Joystick latency histogram could not be saved" };
+_kernel_oserror error_stick = { 0x81A734, "Joystick number not emulated" };
+_kernel_oserror error_source = { 0x81A735, "Joystick input source not enabled" };
+_kernel_oserror FakeJSType_syntax = { 0xdc, "Syntax: *FakeJSType [analogue|switched|damped]" };
+_kernel_oserror FakeJSLatency_syntax = { 0xdc, "Syntax: *FakeJSLatency [on|off|reset|save <filename>]" };
+_kernel_oserror FakeJSSource_syntax = { 0xdc, "Syntax: *FakeJSSource [keypad|mouse|inject on|off [<gain>]]" };
+
+/* Veneers normally generated by CMHG (never called on the host) */
+void event_veneer(void) {}
+void callevery_veneer(void) {}
+void callback_veneer(void) {}
+
+/* ----------------------------------------------------------------------- */
+
+static void take_interrupt(void)
+{
+  if(stub_interrupt != NULL && !stub_irqs_off) {
+    stub_irqs_off = true;
+    stub_interrupt();
+    stub_irqs_off = false;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+int _kernel_osbyte(int op, int x, int y)
+{
+  (void)op;
+  (void)x;
+  (void)y;
+  return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int _kernel_osword(int op, int *data)
+{
+  const unsigned char *params = (const unsigned char *)data;
+
+  if(op == 21 && params[0] == 3) {
+    /* Set mouse position (16-bit signed coordinates, little-endian) */
+    stub_mouse_x = (signed short)(params[1] | (params[2] << 8));
+    stub_mouse_y = (signed short)(params[3] | (params[4] << 8));
+    stub_recentres++;
+  }
+  return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+_kernel_oserror *_kernel_last_oserror(void)
+{
+  return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+_kernel_oserror *_kernel_swi(int no, _kernel_swi_regs *in, _kernel_swi_regs *out)
+{
+  (void)in;
+
+  switch(no) {
+    case OS_Mouse:
+      out->r[0] = stub_mouse_x;
+      out->r[1] = stub_mouse_y;
+      out->r[2] = stub_mouse_buttons;
+      out->r[3] = (int)stub_time;
+      break;
+
+    case OS_ReadMonotonicTime:
+      out->r[0] = (int)stub_time;
+      break;
+
+    case OS_CallEvery:
+      stub_tickers++;
+      break;
+
+    case OS_RemoveTickerEvent:
+      stub_tickers--;
+      break;
+
+    case OS_AddCallBack:
+      stub_callbacks++;
+      break;
+
+    case OS_RemoveCallBack:
+      stub_callbacks--;
+      break;
+  }
+
+  take_interrupt();
+  return NULL; /* success */
+}
+
+/* ----------------------------------------------------------------------- */
+
+void _kernel_irqs_on(void)
+{
+  stub_irqs_off = false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void _kernel_irqs_off(void)
+{
+  take_interrupt();
+  stub_irqs_off = true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int _kernel_irqs_disabled(void)
+{
+  return stub_irqs_off;
+}
@@ -0,0 +1,46 @@
+/*
+ *  FakeJoystick - joystick emulation module
+ *  Copyright (C) 2002  Chris Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Stand-ins for the RISC OS kernel interfaces used by the module, so that
+   it can be exercised on the host. */
+
+#ifndef Stubs_h
+#define Stubs_h
+
+#include <stdbool.h>
+
+/* Values returned by OS_Mouse and OS_ReadMonotonicTime */
+extern int stub_mouse_x, stub_mouse_y, stub_mouse_buttons;
+
+/* Number of times OS_Word 21,3 has set the mouse position */
+extern int stub_recentres;
+extern unsigned int stub_time;
+
+/* Number of OS_CallEvery and OS_AddCallBack routines outstanding */
+extern int stub_tickers, stub_callbacks;
+
+/* Whether _kernel_irqs_off is in effect */
+extern bool stub_irqs_off;
+
+/* If set, called on return from each SWI made with interrupts enabled and
+   before interrupts are disabled, as if an interrupt had been pending (it
+   is called with them disabled) */
+extern void (*stub_interrupt)(void);
+
+#endif
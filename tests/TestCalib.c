@@ -0,0 +1,179 @@
+/*
+ *  FakeJoystick - joystick emulation module
+ *  Copyright (C) 2002  Chris Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Host test: Joystick_Read output is mapped through the calibration tables,
+   which leave every position unchanged until both extremes are captured. */
+
+#include "TestUtils.h"
+
+#define X_16(state) ((state) >> 16)
+#define Y_16(state) ((state) & 0xffffu)
+#define X_8(state) (((state) >> 8) & 0xffu)
+#define Y_8(state) ((state) & 0xffu)
+
+/* ----------------------------------------------------------------------- */
+
+static void inject(unsigned int x, unsigned int y)
+{
+  /* Place the stick at a 16-bit position (keypad centred) */
+  _kernel_swi_regs regs;
+  regs.r[0] = 0; /* joystick 0, set state */
+  regs.r[1] = (int)((x << 16) | y);
+  regs.r[2] = 0;
+  CHECK(FakeJoystick_swihandler(3, &regs, NULL) == NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void calibrate(int swi_no, unsigned int x, unsigned int y)
+{
+  /* Capture one extreme (1 = top right, 2 = bottom left) */
+  _kernel_swi_regs regs;
+  inject(x, y);
+  CHECK(FakeJoystick_swihandler(swi_no, &regs, NULL) == NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *read_8(void)
+{
+  _kernel_swi_regs regs;
+  regs.r[0] = 0; /* joystick 0, 8-bit state */
+  return FakeJoystick_swihandler(0, &regs, NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void identity(void)
+{
+  /* Uncalibrated output matches the formulas used before calibration */
+  CHECK(command(CMD_FakeJSType, "damped") == NULL);
+  for(signed int d = -127 * FIXED_POINT_ONE; d <= 127 * FIXED_POINT_ONE; d++) {
+    damp_x = d;
+    damp_y = -d;
+    publish();
+    CHECK(X_8(published_8) == ((unsigned int)(d / FIXED_POINT_ONE) & 0xffu));
+    CHECK(Y_8(published_8) == ((unsigned int)(-d / FIXED_POINT_ONE) & 0xffu));
+    CHECK(X_16(published_16) == (unsigned int)(0x7fff + (d >> 2)));
+    CHECK(Y_16(published_16) == (unsigned int)(0x7fff + (-d >> 2)));
+    if(failures > 10)
+      return;
+  }
+
+  CHECK(command(CMD_FakeJSType, "analogue") == NULL);
+  for(signed int x = -127; x <= 127; x++) {
+    AXES_SET_X(axes, x);
+    AXES_SET_Y(axes, -x);
+    publish();
+    CHECK(X_8(published_8) == ((unsigned int)x & 0xffu));
+    CHECK(Y_8(published_8) == ((unsigned int)-x & 0xffu));
+    CHECK(X_16(published_16) == (unsigned int)(0x7fff + (x << 8)));
+    CHECK(Y_16(published_16) == (unsigned int)(0x7fff + (-x << 8)));
+  }
+  axes = AXES_CENTRE;
+  publish();
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void extremes(void)
+{
+  CHECK(command(CMD_FakeJSType, "analogue") == NULL);
+
+  /* Reads fail until both extremes have been captured */
+  calibrate(1, 0x7fff + 0x3000, 0x7fff + 0x2000);
+  CHECK(read_8() == &error_calib);
+  calibrate(2, 0x7fff - 0x1000, 0x7fff - 0x2000);
+  CHECK(read_8() == NULL);
+
+  /* The captured extremes span the full range */
+  inject(0x7fff + 0x3000, 0x7fff + 0x2000);
+  CHECK(X_8(published_8) == 127 && Y_8(published_8) == 127);
+  CHECK(X_16(published_16) == 65279 && Y_16(published_16) == 65279);
+  inject(0x7fff - 0x1000, 0x7fff - 0x2000);
+  CHECK(X_8(published_8) == (-127 & 0xffu) && Y_8(published_8) == (-127 & 0xffu));
+  CHECK(X_16(published_16) == 255 && Y_16(published_16) == 255);
+
+  /* ...with the centre halfway between them */
+  inject(0x7fff + 0x1000, 0x7fff);
+  CHECK(published_8 == 0);
+  CHECK(published_16 == 0x7fff7fff);
+
+  /* Positions beyond the extremes are limited to the full range */
+  inject(0xffff, 0);
+  CHECK(X_16(published_16) == 65279 && Y_16(published_16) == 255);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void interpolation(void)
+{
+  /* 16-bit values in between are interpolated from the table, so they stay
+     within one unit of the exact linear mapping (with the calibration from
+     extremes(): X centre 0x1000, half span 0x2000) */
+  unsigned int last = 0;
+  for(unsigned int x = 0x7fff - 0x1000; x <= 0x7fff + 0x3000; x++) {
+    signed int exact = 0x7fff + ((signed int)x - 0x7fff - 0x1000) * RANGE_16 / 0x2000;
+    signed int diff;
+    inject(x, 0x7fff);
+    diff = (signed int)X_16(published_16) - exact;
+    CHECK(diff >= -1 && diff <= 1);
+    CHECK(X_16(published_16) >= last);
+    last = X_16(published_16);
+    if(failures > 10)
+      return;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void small_span(void)
+{
+  /* An axis that barely moves is left uncalibrated, even off centre */
+  CHECK(command(CMD_FakeJSType, "analogue") == NULL);
+  calibrate(1, 0x7fff + 100 * 256, 0x7fff + 0x2000);
+  calibrate(2, 0x7fff + 100 * 256 - 255, 0x7fff - 0x2000);
+
+  inject(0x7fff, 0x7fff);
+  CHECK(published_8 == 0);
+  CHECK(published_16 == 0x7fff7fff);
+  inject(0x7fff + 100 * 256, 0x7fff + 0x2000);
+  CHECK(X_8(published_8) == 100 && Y_8(published_8) == 127);
+  CHECK(X_16(published_16) == 0x7fff + 100 * 256 && Y_16(published_16) == 65279);
+
+  /* Changing the emulation type discards calibration */
+  CHECK(command(CMD_FakeJSType, "analogue") == NULL);
+  inject(0x7fff, 0x7fff + 0x2000);
+  CHECK(published_16 == 0x7fff0000 + 0x7fff + 0x2000);
+}
+
+/* ----------------------------------------------------------------------- */
+
+int main(void)
+{
+  CHECK(FakeJoystick_initialise("", 0, NULL) == NULL);
+
+  identity();
+  extremes();
+  interpolation();
+  small_span();
+
+  CHECK(FakeJoystick_finalise(0, 0, NULL) == NULL);
+  return test_result();
+}
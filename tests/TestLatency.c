@@ -0,0 +1,150 @@
+/*
+ *  FakeJoystick - joystick emulation module
+ *  Copyright (C) 2002  Chris Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Host test: *FakeJSLatency only times key transitions that change the
+   joystick state, and matches them with the read that shows the change. */
+
+#include "TestUtils.h"
+
+/* ----------------------------------------------------------------------- */
+
+static void read_at(unsigned int time)
+{
+  _kernel_swi_regs regs;
+  stub_time = time;
+  regs.r[0] = 0; /* joystick 0, 8-bit state */
+  CHECK(FakeJoystick_swihandler(0, &regs, NULL) == NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void switched(void)
+{
+  CHECK(command(CMD_FakeJSType, "switched") == NULL);
+
+  /* Immediate effect, seen by the next read */
+  stub_time = 100;
+  key(KEY_KP4, true);
+  CHECK(latency_pending);
+  read_at(103);
+  CHECK(!latency_pending);
+  CHECK(latency_hist[MODE_SWITCHED][3] == 1);
+
+  /* Releasing left whilst right is held doesn't move the stick */
+  key(KEY_KP6, true);
+  read_at(103);
+  CHECK(latency_hist[MODE_SWITCHED][0] == 1);
+  key(KEY_KP4, false);
+  CHECK(!latency_pending);
+  key(KEY_KP6, false);
+  read_at(103);
+  CHECK(latency_hist[MODE_SWITCHED][0] == 2);
+
+  /* Centring a centred stick changes nothing */
+  key(KEY_KP5, true);
+  CHECK(!latency_pending);
+  key(KEY_KP5, false);
+  CHECK(!latency_pending);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void analogue(void)
+{
+  CHECK(command(CMD_FakeJSType, "analogue") == NULL);
+
+  /* Direction keys take effect at the next tick */
+  stub_time = 200;
+  key(KEY_KP4, true);
+  CHECK(latency_pending);
+  read_at(201);
+  CHECK(latency_pending);
+  tick();
+  read_at(204);
+  CHECK(!latency_pending);
+  CHECK(latency_hist[MODE_ANALOGUE][4] == 1);
+
+  /* Releasing a direction key leaves the stick where it is */
+  key(KEY_KP4, false);
+  CHECK(!latency_pending);
+
+  /* ...so it doesn't hold up timing of the next transition */
+  stub_time = 300;
+  key(KEY_KPENTER, true);
+  CHECK(latency_pending);
+  read_at(302);
+  CHECK(latency_hist[MODE_ANALOGUE][2] == 1);
+  key(KEY_KPENTER, false);
+  read_at(302);
+  CHECK(latency_hist[MODE_ANALOGUE][0] == 1);
+
+  /* A read after several ticks still shows the effect */
+  stub_time = 400;
+  key(KEY_KP8, true);
+  tick();
+  tick();
+  tick();
+  read_at(412);
+  CHECK(!latency_pending);
+  CHECK(latency_hist[MODE_ANALOGUE][12] == 1);
+  key(KEY_KP8, false);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void damped(void)
+{
+  CHECK(command(CMD_FakeJSType, "damped") == NULL);
+
+  /* Movement carries on until the read, but the effect was still seen */
+  stub_time = 500;
+  key(KEY_KP6, true);
+  CHECK(latency_pending);
+  tick();
+  tick();
+  read_at(508);
+  CHECK(!latency_pending);
+  CHECK(latency_hist[MODE_DAMPED][8] == 1);
+
+  /* Undoing the key before the next tick means nothing is seen */
+  key(KEY_KP6, false);
+  CHECK(latency_pending);
+  key(KEY_KP6, true);
+  read_at(520);
+  tick();
+  read_at(700);
+  CHECK(!latency_pending);
+  CHECK(latency_lost[MODE_DAMPED] == 1);
+}
+
+/* ----------------------------------------------------------------------- */
+
+int main(void)
+{
+  CHECK(FakeJoystick_initialise("", 0, NULL) == NULL);
+  CHECK(command(CMD_FakeJSLatency, "on") == NULL);
+
+  switched();
+  analogue();
+  damped();
+
+  CHECK(FakeJoystick_finalise(0, 0, NULL) == NULL);
+
+  return test_result();
+}
@@ -0,0 +1,88 @@
+/*
+ *  FakeJoystick - joystick emulation module
+ *  Copyright (C) 2002  Chris Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Host test: the packed-axis (SWAR) analogue step gives the same result as
+   the original per-axis code for every position and combination of keys. */
+
+#include "TestUtils.h"
+
+/* ----------------------------------------------------------------------- */
+
+static void per_axis_step(signed char *x_axis, signed char *y_axis,
+                          bool left, bool right, bool up, bool down)
+{
+  /* callevery_handler's analogue code before the axes were packed */
+  if(left) {
+    if(*x_axis > -123)
+      *x_axis -= 5;
+    else
+      *x_axis = -127;
+  }
+  if(right) {
+    if(*x_axis < 123)
+      *x_axis += 5;
+    else
+      *x_axis = 127;
+  }
+  if(up) {
+    if(*y_axis < 123)
+      *y_axis += 5;
+    else
+      *y_axis = 127;
+  }
+  if(down) {
+    if(*y_axis > -123)
+      *y_axis -= 5;
+    else
+      *y_axis = -127;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+int main(void)
+{
+  for(unsigned int k = 0; k < 16; k++) {
+    bool left = k & 1, right = k & 2, up = k & 4, down = k & 8;
+    uint32_t key_mask = (left ? KEYS_LEFT : 0) | (right ? KEYS_RIGHT : 0) |
+                        (up ? KEYS_UP : 0) | (down ? KEYS_DOWN : 0);
+
+    for(int x = -127; x <= 127; x++) {
+      for(int y = -127; y <= 127; y++) {
+        signed char x_axis = (signed char)x, y_axis = (signed char)y;
+        uint32_t a = AXES_CENTRE;
+
+        per_axis_step(&x_axis, &y_axis, left, right, up, down);
+
+        AXES_SET_X(a, x);
+        AXES_SET_Y(a, y);
+        a = analogue_step(a, key_mask);
+
+        if(AXES_X(a) != x_axis || AXES_Y(a) != y_axis) {
+          if(failures < 10)
+            printf("keys %u at %d,%d: expected %d,%d, got %d,%d\n",
+                   k, x, y, x_axis, y_axis, AXES_X(a), AXES_Y(a));
+          failures++;
+        }
+      }
+    }
+  }
+
+  return test_result();
+}
@@ -0,0 +1,264 @@
+/*
+ *  FakeJoystick - joystick emulation module
+ *  Copyright (C) 2002  Chris Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Host test: the keypad, mouse and Joystick_FakeInject sources are merged
+   into the state returned by Joystick_Read, and the mouse's ticker and
+   callback routines are all removed again. */
+
+#include "TestUtils.h"
+
+/* Expected values of published_8 and published_16 (default calibration) */
+#define STATE_8(x, y, b) (((unsigned int)(y) & 0xffu) | (((unsigned int)(x) & 0xffu) << 8) | ((unsigned int)(b) << 16))
+#define STATE_16(x, y) (((unsigned int)(x) << 16) | (unsigned int)(y))
+
+/* ----------------------------------------------------------------------- */
+
+static void mouse_move(int dx, int dy)
+{
+  /* Move the pointer from its home position and let the module read it */
+  _kernel_swi_regs regs;
+  int home_x = stub_mouse_x, home_y = stub_mouse_y;
+  stub_mouse_x += dx;
+  stub_mouse_y += dy;
+  tick();
+  CHECK(callback_pending);
+  CHECK(stub_callbacks == 1);
+  stub_callbacks--; /* the OS calls each callback once */
+  callback_handler(&regs, NULL);
+  CHECK(!callback_pending);
+  CHECK(!stub_irqs_off);
+
+  /* The pointer is put back, ready for the next movement */
+  CHECK(stub_mouse_x == home_x && stub_mouse_y == home_y);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _kernel_oserror *inject(int reason_code, int stick_num, unsigned int x, unsigned int y, unsigned int b)
+{
+  _kernel_swi_regs regs;
+  _kernel_oserror *err;
+  regs.r[0] = stick_num | (reason_code << 8);
+  regs.r[1] = (int)((x << 16) | y);
+  regs.r[2] = (int)b;
+  err = FakeJoystick_swihandler(3, &regs, NULL);
+  CHECK(!stub_irqs_off);
+  return err;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void injection(void)
+{
+  /* Injected 16-bit values are returned unchanged */
+  CHECK(inject(0, 0, 0x9000, 0x1000, 1) == NULL);
+  CHECK(published_16 == STATE_16(0x9000, 0x1000));
+  CHECK(published_8 == STATE_8(16, -111, 1));
+
+  /* Releasing the joystick centres it */
+  CHECK(inject(1, 0, 0, 0, 0) == NULL);
+  CHECK(published_16 == STATE_16(0x7fff, 0x7fff));
+  CHECK(published_8 == STATE_8(0, 0, 0));
+
+  /* Errors */
+  CHECK(inject(0, 1, 0x9000, 0x1000, 1) == &error_stick);
+  CHECK(inject(2, 0, 0x9000, 0x1000, 1) == &bad_reason);
+  CHECK(command(CMD_FakeJSSource, "inject off") == NULL);
+  CHECK(inject(0, 0, 0x9000, 0x1000, 1) == &error_source);
+  CHECK(command(CMD_FakeJSSource, "inject on") == NULL);
+  CHECK(published_8 == STATE_8(0, 0, 0));
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void keypad_and_injection(void)
+{
+  CHECK(command(CMD_FakeJSType, "switched") == NULL);
+
+  /* Offsets from both sources are added */
+  CHECK(inject(0, 0, 0x9fff, 0x7fff, 2) == NULL);
+  key(KEY_KP4, true);
+  CHECK(published_16 == STATE_16(0x7fff - 32 * 256, 0x7fff));
+  CHECK(published_8 == STATE_8(-32, 0, 2));
+  key(KEY_KP4, false);
+  CHECK(published_16 == STATE_16(0x9fff, 0x7fff));
+  CHECK(published_8 == STATE_8(32, 0, 2));
+
+  /* ...but limited to the full range of travel */
+  CHECK(inject(0, 0, 0x7fff, 0xffff, 0) == NULL);
+  key(KEY_KP8, true);
+  CHECK(published_16 == STATE_16(0x7fff, 0x7fff + 127 * 256));
+  CHECK(published_8 == STATE_8(0, 127, 0));
+  key(KEY_KP8, false);
+
+  CHECK(inject(1, 0, 0, 0, 0) == NULL);
+  CHECK(published_8 == STATE_8(0, 0, 0));
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void mouse(void)
+{
+  stub_mouse_x = 100;
+  stub_mouse_y = 100;
+  CHECK(command(CMD_FakeJSSource, "mouse on 1") == NULL);
+  CHECK(stub_tickers == 1); /* even in "switched" mode */
+
+  /* A gain of 1 gives full 16-bit resolution */
+  mouse_move(3, -2);
+  CHECK(published_16 == STATE_16(0x7fff + 3, 0x7fff - 2));
+  CHECK(published_8 == STATE_8(0, 0, 0));
+
+  /* Changing the gain keeps the stick where it is */
+  CHECK(command(CMD_FakeJSSource, "mouse on 256") == NULL);
+  CHECK(mouse_gain == 256);
+  mouse_move(1, 0);
+  CHECK(published_16 == STATE_16(0x7fff + 3 + 256, 0x7fff - 2));
+  CHECK(published_8 == STATE_8(1, 0, 0));
+
+  /* Select and Adjust are fire buttons A and B */
+  stub_mouse_buttons = 4;
+  mouse_move(0, 0);
+  CHECK(published_8 == STATE_8(1, 0, 1));
+  stub_mouse_buttons = 1;
+  mouse_move(0, 0);
+  CHECK(published_8 == STATE_8(1, 0, 2));
+  stub_mouse_buttons = 0;
+  mouse_move(0, 0);
+  CHECK(published_8 == STATE_8(1, 0, 0));
+
+  /* Bad gains are rejected */
+  CHECK(command(CMD_FakeJSSource, "mouse on 0") == &FakeJSSource_syntax);
+  CHECK(command(CMD_FakeJSSource, "mouse on 257") == &FakeJSSource_syntax);
+  CHECK(command(CMD_FakeJSSource, "mouse on 1x") == &FakeJSSource_syntax);
+  CHECK(command(CMD_FakeJSSource, "keypad on 1") == &FakeJSSource_syntax);
+  CHECK(command(CMD_FakeJSSource, "mouse off 1") == &FakeJSSource_syntax);
+  CHECK(mouse_gain == 256);
+
+  /* Keypad and mouse offsets are added */
+  key(KEY_KP6, true);
+  CHECK(published_16 == STATE_16(0x7fff + 64 * 256 + 259, 0x7fff - 2));
+  CHECK(published_8 == STATE_8(65, 0, 0));
+  mouse_move(-5, 0);
+  CHECK(published_16 == STATE_16(0x7fff + 64 * 256 - 1021, 0x7fff - 2));
+  CHECK(published_8 == STATE_8(60, 0, 0));
+  key(KEY_KP6, false);
+  CHECK(published_16 == STATE_16(0x7fff - 1021, 0x7fff - 2));
+  CHECK(published_8 == STATE_8(-3, 0, 0));
+
+  /* Disabling the mouse centres it and removes the ticker */
+  CHECK(command(CMD_FakeJSSource, "mouse off") == NULL);
+  CHECK(published_16 == STATE_16(0x7fff, 0x7fff));
+  CHECK(published_8 == STATE_8(0, 0, 0));
+  CHECK(stub_tickers == 0);
+  CHECK(stub_callbacks == 0);
+
+  /* Ticks no longer ask to read the pointer */
+  tick();
+  CHECK(stub_callbacks == 0);
+  CHECK(command(CMD_FakeJSSource, "mouse on 64") == NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void mouse_travel(void)
+{
+  /* Because the pointer is put back after each read, a gain of 1 still
+     reaches the full range, however small the screen */
+  int recentres = stub_recentres;
+  CHECK(command(CMD_FakeJSSource, "mouse on 1") == NULL);
+  for(int i = 0; i < 65; i++)
+    mouse_move(500, -500);
+  CHECK(stub_recentres == recentres + 65);
+  CHECK(published_16 == STATE_16(0x7fff + 32500, 0x7fff - 32500));
+  mouse_move(500, -500);
+  CHECK(published_16 == STATE_16(65279, 255));
+  CHECK(published_8 == STATE_8(127, -127, 0));
+
+  CHECK(command(CMD_FakeJSSource, "mouse off") == NULL);
+  CHECK(published_8 == STATE_8(0, 0, 0));
+  CHECK(command(CMD_FakeJSSource, "mouse on 64") == NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void keypad_off(void)
+{
+  /* Disabling the keypad whilst a key is held centres the stick for good,
+     even if the ticker fires during the reset */
+  CHECK(command(CMD_FakeJSType, "analogue") == NULL);
+  key(KEY_KP6, true);
+  tick();
+  CHECK(published_8 == STATE_8(5, 0, 0));
+  stub_interrupt = tick;
+  CHECK(command(CMD_FakeJSSource, "keypad off") == NULL);
+  stub_interrupt = NULL;
+  CHECK(!stub_irqs_off);
+  CHECK(published_8 == STATE_8(0, 0, 0));
+  tick();
+  CHECK(published_8 == STATE_8(0, 0, 0));
+  CHECK(command(CMD_FakeJSSource, "keypad on") == NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void teardown(void)
+{
+  /* The ticker stays attached in "analogue" mode, so it may try to add a
+     callback whilst the mouse is being disabled */
+  CHECK(command(CMD_FakeJSType, "analogue") == NULL);
+  CHECK(stub_tickers == 1);
+
+  tick();
+  CHECK(stub_callbacks == 1);
+  stub_interrupt = tick;
+  CHECK(command(CMD_FakeJSSource, "mouse off") == NULL);
+  stub_interrupt = NULL;
+  CHECK(!callback_pending);
+  CHECK(stub_callbacks == 0);
+  CHECK(stub_tickers == 1);
+
+  /* Likewise whilst the module is being killed */
+  CHECK(command(CMD_FakeJSSource, "mouse on") == NULL);
+  tick();
+  CHECK(stub_callbacks == 1);
+  stub_interrupt = tick;
+  CHECK(FakeJoystick_finalise(0, 0, NULL) == NULL);
+  stub_interrupt = NULL;
+  CHECK(stub_callbacks == 0);
+  CHECK(stub_tickers == 0);
+}
+
+/* ----------------------------------------------------------------------- */
+
+int main(void)
+{
+  CHECK(FakeJoystick_initialise("", 0, NULL) == NULL);
+  CHECK(published_16 == STATE_16(0x7fff, 0x7fff));
+  CHECK(published_8 == STATE_8(0, 0, 0));
+
+  injection();
+  keypad_and_injection();
+  mouse();
+  mouse_travel();
+  keypad_off();
+  teardown();
+
+  return test_result();
+}
@@ -0,0 +1,82 @@
+/*
+ *  FakeJoystick - joystick emulation module
+ *  Copyright (C) 2002  Chris Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Checks and helpers shared by the host tests. Each test includes this
+   header once, in place of the module itself. */
+
+#ifndef TestUtils_h
+#define TestUtils_h
+
+/* The module's internals are static, so compile it into the test */
+#include "FakeJoystick.c"
+
+#include "Stubs.h"
+
+static int failures;
+
+#define CHECK(cond) \
+  do { \
+    if(!(cond)) { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while(0)
+
+/* ----------------------------------------------------------------------- */
+
+static inline _kernel_oserror *command(int cmd_no, const char *arg)
+{
+  /* Count the arguments, as the OS would */
+  int argc = 0;
+  for(int i = 0; arg[i] != '\0'; i++) {
+    if(arg[i] != ' ' && (i == 0 || arg[i - 1] == ' '))
+      argc++;
+  }
+  return cmd_handler(arg, argc, cmd_no, NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static inline void key(int key_num, bool press)
+{
+  _kernel_swi_regs regs;
+  regs.r[0] = EVENT_KEYTRANS;
+  regs.r[1] = press;
+  regs.r[2] = key_num;
+  event_handler(&regs, NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static inline void tick(void)
+{
+  _kernel_swi_regs regs;
+  callevery_handler(&regs, NULL);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static inline int test_result(void)
+{
+  /* Report the outcome, for use as the return value of main */
+  printf("%d failures\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif